@@ -0,0 +1,351 @@
+// End-to-end latency of the real powerprompt executable.
+//
+// Generates a repository of the requested shape with the local git, then
+// runs powerprompt in it many times for each status strategy and prints
+// wall time, CPU time and memory percentiles as JSON on stdout.
+//
+// powerprompt_e2e_bench [--powerprompt <exe>] [--work <dir>] [--files N]
+//     [--commits N] [--modified N] [--untracked N] [--ahead N] [--behind N]
+//     [--runs N] [--strategies subprocess,degraded,shared]
+
+#include <algorithm>
+#include <boost/process.hpp>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <windows.h>
+#include <psapi.h>
+
+#include "percentiles.hpp"
+
+namespace bp = boost::process;
+namespace fs = std::filesystem;
+
+struct Shape {
+  unsigned int files = 1000;
+  unsigned int commits = 100;
+  unsigned int modified = 0;
+  unsigned int untracked = 0;
+  unsigned int ahead = 0;
+  unsigned int behind = 0;
+};
+
+struct Options {
+  fs::path powerprompt = POWERPROMPT_EXECUTABLE;
+  fs::path work = fs::temp_directory_path() / "powerprompt_e2e_bench";
+  Shape shape;
+  unsigned int runs = 50;
+  std::vector<std::string> strategies = {"subprocess", "degraded", "shared"};
+};
+
+/////////////////////////////////////////////////////////
+// Repository generation
+
+void git(fs::path const & directory, std::string const & arguments) {
+  int const result = bp::system("git " + arguments, bp::start_dir = directory.string(), bp::std_out > bp::null, bp::std_err > bp::null);
+  if(result != 0) {
+    throw std::runtime_error("git " + arguments + " failed in " + directory.string());
+  }
+}
+
+void write(fs::path const & file, std::string const & content) {
+  fs::create_directories(file.parent_path());
+  std::ofstream(file, std::ios::binary) << content;
+}
+
+// 100 files per directory, like a real tree rather than one huge directory.
+fs::path getFile(fs::path const & repository, unsigned int index) {
+  return repository / ("dir" + std::to_string(index / 100)) / ("file" + std::to_string(index % 100) + ".txt");
+}
+
+// Deep histories are imported in one go, committing them one by one takes ages.
+void importHistory(fs::path const & repository, unsigned int nbCommits) {
+
+  bp::opstream stream;
+  bp::child importer("git fast-import --quiet", bp::start_dir = repository.string(), bp::std_in < stream, bp::std_out > bp::null);
+
+  for(unsigned int i = 1; i <= nbCommits; ++i) {
+    std::string const message = "commit " + std::to_string(i) + "\n";
+    std::string const content = std::to_string(i) + "\n";
+    stream << "commit refs/heads/main\n"
+           << "mark :" << i << "\n"
+           << "committer Bench <bench@example.com> " << 1600000000 + i << " +0000\n"
+           << "data " << message.size() << "\n" << message;
+    if(i > 1) {
+      stream << "from :" << i - 1 << "\n";
+    }
+    stream << "M 100644 inline history.txt\n"
+           << "data " << content.size() << "\n" << content << "\n";
+  }
+
+  stream.flush();
+  stream.pipe().close();
+  importer.wait();
+  if(importer.exit_code() != 0) {
+    throw std::runtime_error("git fast-import failed");
+  }
+}
+
+void commitFile(fs::path const & repository, std::string const & name, unsigned int i) {
+  write(repository / name, std::to_string(i) + "\n");
+  git(repository, "add " + name);
+  git(repository, "commit -q -m \"" + name + " " + std::to_string(i) + "\"");
+}
+
+// A working repository with a local bare "origin".
+fs::path generateRepository(fs::path const & work, Shape const & shape) {
+
+  fs::remove_all(work);
+  fs::path const origin = work / "origin.git";
+  fs::path const repository = work / "repository";
+  fs::create_directories(repository);
+
+  git(work, "init -q --bare origin.git");
+  git(repository, "init -q");
+  git(repository, "config user.name Bench");
+  git(repository, "config user.email bench@example.com");
+
+  importHistory(repository, std::max(shape.commits, 1u));
+  git(repository, "checkout -q -f main");
+
+  for(unsigned int i = 0; i < shape.files; ++i) {
+    write(getFile(repository, i), std::to_string(i) + "\n");
+  }
+  git(repository, "add -A");
+  git(repository, "commit -q -m files");
+
+  git(repository, "remote add origin " + origin.generic_string());
+  git(repository, "push -q -u origin main");
+
+  // Commits only the origin has...
+  for(unsigned int i = 0; i < shape.behind; ++i) {
+    commitFile(repository, "behind.txt", i);
+  }
+  if(shape.behind != 0) {
+    git(repository, "push -q origin main");
+    git(repository, "reset -q --hard HEAD~" + std::to_string(shape.behind));
+  }
+
+  // ...and commits only we have.
+  for(unsigned int i = 0; i < shape.ahead; ++i) {
+    commitFile(repository, "ahead.txt", i);
+  }
+
+  for(unsigned int i = 0; i < std::min(shape.modified, shape.files); ++i) {
+    write(getFile(repository, i), "modified\n");
+  }
+
+  // Next to tracked files: git would report a directory of untracked
+  // files as a single entry, without looking inside.
+  for(unsigned int i = 0; i < shape.untracked; ++i) {
+    fs::path const directory = getFile(repository, shape.files == 0 ? 0 : i % shape.files).parent_path();
+    write(directory / ("untracked" + std::to_string(i) + ".txt"), "untracked\n");
+  }
+
+  return repository;
+}
+
+/////////////////////////////////////////////////////////
+// Measurement
+
+struct Sample {
+  double wallMs = 0;
+  double cpuMs = 0;             // powerprompt and the git processes it spawned
+  std::uint64_t maxRssKb = 0;   // peak working set of powerprompt
+  std::uint64_t maxProcessMemoryKb = 0;  // peak commit of the largest process of the run
+};
+
+double toMs(LARGE_INTEGER const & ticks) {
+  return static_cast<double>(ticks.QuadPart) / 10000.0;  // 100 ns units
+}
+
+// The process is started suspended and put in its own job before it can
+// spawn git, so the job accounts for the whole process tree.
+Sample run(fs::path const & powerprompt, fs::path const & repository) {
+
+  SECURITY_ATTRIBUTES inheritable = {sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+  HANDLE const nul = CreateFileW(L"NUL", GENERIC_WRITE, FILE_SHARE_WRITE, &inheritable, OPEN_EXISTING, 0, nullptr);
+  HANDLE const job = CreateJobObjectW(nullptr, nullptr);
+
+  STARTUPINFOW startup = {};
+  startup.cb = sizeof(startup);
+  startup.dwFlags = STARTF_USESTDHANDLES;
+  startup.hStdOutput = nul;
+  startup.hStdError = nul;
+
+  std::wstring commandLine = L"\"" + powerprompt.wstring() + L"\"";
+  PROCESS_INFORMATION process = {};
+
+  auto const start = std::chrono::steady_clock::now();
+  if(!CreateProcessW(nullptr, commandLine.data(), nullptr, nullptr, TRUE, CREATE_SUSPENDED, nullptr,
+                     repository.wstring().c_str(), &startup, &process)) {
+    CloseHandle(job);
+    CloseHandle(nul);
+    throw std::runtime_error("cannot start " + powerprompt.string());
+  }
+  AssignProcessToJobObject(job, process.hProcess);
+  ResumeThread(process.hThread);
+  WaitForSingleObject(process.hProcess, INFINITE);
+  auto const end = std::chrono::steady_clock::now();
+
+  Sample sample;
+  sample.wallMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+  JOBOBJECT_BASIC_ACCOUNTING_INFORMATION accounting = {};
+  QueryInformationJobObject(job, JobObjectBasicAccountingInformation, &accounting, sizeof(accounting), nullptr);
+  sample.cpuMs = toMs(accounting.TotalUserTime) + toMs(accounting.TotalKernelTime);
+
+  JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+  QueryInformationJobObject(job, JobObjectExtendedLimitInformation, &limits, sizeof(limits), nullptr);
+  sample.maxProcessMemoryKb = limits.PeakProcessMemoryUsed / 1024;
+
+  PROCESS_MEMORY_COUNTERS memory = {};
+  GetProcessMemoryInfo(process.hProcess, &memory, sizeof(memory));
+  sample.maxRssKb = memory.PeakWorkingSetSize / 1024;
+
+  CloseHandle(process.hThread);
+  CloseHandle(process.hProcess);
+  CloseHandle(job);
+  CloseHandle(nul);
+  return sample;
+}
+
+void setEnvironment(std::string const & name, std::string const & value) {
+  SetEnvironmentVariableW(fs::path(name).wstring().c_str(), fs::path(value).wstring().c_str());
+}
+
+// Makes the next prompt start from nothing: powerprompt's cache files and
+// shared table entry are invalidated, and git has to re-check the index.
+// The operating system file cache cannot be dropped without privileges,
+// so "cold" does not include it.
+void invalidate(fs::path const & work, fs::path const & repository, unsigned int run) {
+  setEnvironment("POWERPROMPT_CACHE_DIR", (work / "cache" / std::to_string(run)).string());
+  fs::last_write_time(repository / ".git" / "index", fs::file_time_type::clock::now());
+}
+
+/////////////////////////////////////////////////////////
+// Report
+
+void writeResult(std::ostream & os, std::string const & strategy, std::string const & cache, std::vector<Sample> const & samples) {
+
+  std::vector<double> wall;
+  std::vector<double> cpu;
+  std::uint64_t maxRssKb = 0;
+  std::uint64_t maxProcessMemoryKb = 0;
+  for(auto const & sample: samples) {
+    wall.push_back(sample.wallMs);
+    cpu.push_back(sample.cpuMs);
+    maxRssKb = std::max(maxRssKb, sample.maxRssKb);
+    maxProcessMemoryKb = std::max(maxProcessMemoryKb, sample.maxProcessMemoryKb);
+  }
+
+  os << "    {\"strategy\": \"" << strategy << "\", \"cache\": \"" << cache << "\", \"runs\": " << samples.size();
+  os << ", \"wall_ms\": ";
+  writePercentiles(os, wall);
+  os << ", \"cpu_ms\": ";
+  writePercentiles(os, cpu);
+  os << ", \"max_rss_kb\": " << maxRssKb;
+  os << ", \"max_process_memory_kb\": " << maxProcessMemoryKb << "}";
+}
+
+/////////////////////////////////////////////////////////
+
+Options parseOptions(int argc, char * argv[]) {
+
+  Options options;
+  std::map<std::string, unsigned int *> const counts = {
+      {"--files", &options.shape.files},
+      {"--commits", &options.shape.commits},
+      {"--modified", &options.shape.modified},
+      {"--untracked", &options.shape.untracked},
+      {"--ahead", &options.shape.ahead},
+      {"--behind", &options.shape.behind},
+      {"--runs", &options.runs},
+  };
+
+  for(int i = 1; i + 1 < argc; i += 2) {
+    std::string const name = argv[i];
+    std::string const value = argv[i + 1];
+
+    if(auto const count = counts.find(name); count != counts.end()) {
+      *count->second = static_cast<unsigned int>(std::stoul(value));
+    }
+    else if(name == "--powerprompt") {
+      options.powerprompt = value;
+    }
+    else if(name == "--work") {
+      options.work = value;
+    }
+    else if(name == "--strategies") {
+      options.strategies.clear();
+      std::istringstream is(value);
+      for(std::string strategy; std::getline(is, strategy, ',');) {
+        options.strategies.push_back(strategy);
+      }
+    }
+    else {
+      throw std::runtime_error("unknown option " + name);
+    }
+  }
+
+  return options;
+}
+
+int main(int argc, char * argv[]) {
+
+  try {
+    Options const options = parseOptions(argc, argv);
+    Shape const & shape = options.shape;
+
+    std::cerr << "generating the repository in " << options.work << '\n';
+    fs::path const repository = generateRepository(options.work, shape);
+    fs::path const powerprompt = fs::absolute(options.powerprompt);
+
+    // powerprompt shows the working directory from PWD, like under Cygwin.
+    setEnvironment("PWD", repository.string());
+
+    std::cout << "{\n";
+    std::cout << "  \"repository\": {\"files\": " << shape.files << ", \"commits\": " << shape.commits
+              << ", \"modified\": " << shape.modified << ", \"untracked\": " << shape.untracked
+              << ", \"ahead\": " << shape.ahead << ", \"behind\": " << shape.behind << "},\n";
+    std::cout << "  \"results\": [\n";
+
+    bool first = true;
+    for(auto const & strategy: options.strategies) {
+      std::cerr << "running " << strategy << '\n';
+      setEnvironment("POWERPROMPT_STRATEGY", strategy);
+
+      std::vector<Sample> cold;
+      for(unsigned int i = 0; i < options.runs; ++i) {
+        invalidate(options.work, repository, i);
+        cold.push_back(run(powerprompt, repository));
+      }
+
+      setEnvironment("POWERPROMPT_CACHE_DIR", (options.work / "cache" / "warm").string());
+      run(powerprompt, repository);
+      std::vector<Sample> warm;
+      for(unsigned int i = 0; i < options.runs; ++i) {
+        warm.push_back(run(powerprompt, repository));
+      }
+
+      for(auto const & [cache, samples]: {std::pair{"cold", &cold}, std::pair{"warm", &warm}}) {
+        std::cout << (first ? "" : ",\n");
+        writeResult(std::cout, strategy, cache, *samples);
+        first = false;
+      }
+    }
+
+    std::cout << "\n  ]\n}\n";
+    return 0;
+  }
+  catch(std::exception const & e) {
+    std::cerr << "powerprompt_e2e_bench: " << e.what() << '\n';
+    return 1;
+  }
+}
@@ -1,6 +1,5 @@
-
 #include "program.cpp"
 
-int main() {
-  return program();
+int main(int argc, char * argv[]) {
+  return program(argc, argv);
 }
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <algorithm>
+#include <ostream>
+#include <vector>
+
+// Shared by the benchmarks, so that their reports compare.
+
+inline double percentile(std::vector<double> values, double p) {
+  if(values.empty()) {
+    return 0;
+  }
+  std::sort(std::begin(values), std::end(values));
+  auto const rank = static_cast<std::size_t>(p / 100.0 * static_cast<double>(values.size() - 1) + 0.5);
+  return values[std::min(rank, values.size() - 1)];
+}
+
+inline void writePercentiles(std::ostream & os, std::vector<double> const & values) {
+  os << "{\"p50\": " << percentile(values, 50)
+     << ", \"p95\": " << percentile(values, 95)
+     << ", \"p99\": " << percentile(values, 99) << "}";
+}
@@ -0,0 +1,62 @@
+// Prompt computation replayed from a recording.
+//
+// Runs the prompt many times from a file made by `powerprompt --record`,
+// without the repository nor git, and prints as JSON on stdout the time the
+// computation itself takes next to the time the recorded facts took.
+//
+// powerprompt_replay_bench <capture> [--runs N]
+
+#include "percentiles.hpp"
+#include "program.cpp"
+
+int main(int argc, char * argv[]) {
+
+  if(argc != 2 && !(argc == 4 && argv[2] == std::string_view("--runs"))) {
+    std::cerr << "usage: powerprompt_replay_bench <capture> [--runs N]\n";
+    return 1;
+  }
+  unsigned int const runs = argc == 4 ? static_cast<unsigned int>(std::stoul(argv[3])) : 1000;
+
+  try {
+    Capture::Session & session = Capture::getSession();
+    session.load(argv[1]);
+    session.mode = Capture::Mode::Replay;
+
+    std::string const expected = getPromptText();
+
+    std::vector<double> wall;
+    for(unsigned int i = 0; i < runs; ++i) {
+      session.rewind();
+      auto const start = std::chrono::steady_clock::now();
+      std::string const prompt = getPromptText();
+      wall.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+      if(prompt != expected) {
+        throw std::runtime_error("the replayed prompt changed between runs");
+      }
+    }
+
+    std::map<std::string, std::int64_t> recorded;
+    for(auto const & fact: session.facts) {
+      recorded[fact.kind] += fact.microseconds;
+    }
+
+    std::cout << "{\n";
+    std::cout << "  \"runs\": " << runs << ",\n";
+    std::cout << "  \"replay_us\": ";
+    writePercentiles(std::cout, wall);
+    std::cout << ",\n";
+    std::cout << "  \"recorded_us\": {";
+    bool first = true;
+    for(auto const & [kind, microseconds]: recorded) {
+      std::cout << (first ? "" : ", ") << '"' << kind << "\": " << microseconds;
+      first = false;
+    }
+    std::cout << "}\n";
+    std::cout << "}\n";
+  }
+  catch(std::exception const & e) {
+    std::cerr << "powerprompt_replay_bench: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}